@@ -5,6 +5,7 @@
 #include <errno.h>
 
 #include "serial.h"
+#include "trace.h"
 
 #define MAX_SETTING_NAME_STR_LEN 15
 
@@ -73,6 +74,7 @@ static int get_tl_settings(const struct termios *mode, int all, char tl_settings
     int prev_type = control;
     char setting[MAX_SETTING_NAME_STR_LEN] = {0};
 
+    TRACE_BEGIN(TRACE_GET_TL_SETTINGS);
     for (i = 0; i < NUM_mode_info; ++i)
     {
         if (mode_info[i].flags & OMIT)
@@ -100,6 +102,7 @@ static int get_tl_settings(const struct termios *mode, int all, char tl_settings
             }
         }
     }
+    TRACE_END(TRACE_GET_TL_SETTINGS);
 
     return EXIT_SUCCESS;
 }
@@ -117,6 +120,7 @@ static int get_speed_baud(const struct termios *mode, unsigned int *ispeed_p, un
 {
     unsigned long ispeed, ospeed;
 
+    TRACE_BEGIN(TRACE_GET_SPEED_BAUD);
     ispeed = cfgetispeed(mode);
     ospeed = cfgetospeed(mode);
     if (ispeed == 0 || ispeed == ospeed)
@@ -125,13 +129,39 @@ static int get_speed_baud(const struct termios *mode, unsigned int *ispeed_p, un
     }
     *ispeed_p = tty_baud_to_value(ispeed);
     *ospeed_p = tty_baud_to_value(ospeed);
+    TRACE_END(TRACE_GET_SPEED_BAUD);
 
     return EXIT_SUCCESS;
 }
 
+#ifdef SERIAL_TRACE
+/* Stop tracing and export "<SERIAL_TRACE_FILE>.json" next to the raw trace */
+static void trace_finish(void)
+{
+    const char *raw_path = getenv("SERIAL_TRACE_FILE");
+    char json_path[4096];
+
+    if (trace_stop() == 0)
+    {
+        snprintf(json_path, sizeof(json_path), "%s.json", raw_path);
+        if (trace_export_chrome(raw_path, json_path))
+        {
+            printf(" Error in exporting trace to %s\n", json_path);
+        }
+    }
+}
+#endif
+
 // For testing
 int main(int argc, char *argv[])
 {
+#ifdef SERIAL_TRACE
+    if (getenv("SERIAL_TRACE_FILE") != NULL && trace_start(getenv("SERIAL_TRACE_FILE")) == 0)
+    {
+        atexit(trace_finish);
+    }
+#endif
+
     if (argc != 2)
     {
         printf(" [Input Error]\n");
@@ -145,13 +175,18 @@ int main(int argc, char *argv[])
 
     struct termios mode;
     memset(&mode, 0, sizeof(mode));
+    TRACE_BEGIN(TRACE_OPEN);
     int fd = open(dev_tty, O_RDWR);
+    TRACE_END(TRACE_OPEN);
     if (fd == -1)
     {
         printf(" Error in open %s\n", dev_tty);
         return 0;
     }
-    if (tcgetattr(fd, &mode))
+    TRACE_BEGIN(TRACE_TCGETATTR);
+    int err = tcgetattr(fd, &mode);
+    TRACE_END(TRACE_TCGETATTR);
+    if (err)
     {
         printf(" Error in calling tcgetattr for %s\n", dev_tty);
         return 0;
@@ -170,7 +205,7 @@ int main(int argc, char *argv[])
         }
     }
     
-    print("\n");
+    printf("\n");
 
     // Get speed baud
     unsigned int ispeed, ospeed = 0;
@@ -0,0 +1,256 @@
+#ifdef SERIAL_TRACE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include "trace.h"
+
+#define TRACE_MAGIC "STRC"
+#define TRACE_VERSION 1
+#define TRACE_FLUSH_INTERVAL_NS 1000000 /* Flusher poll period when all rings are empty */
+
+/* Raw trace file header, followed by struct trace_event records */
+struct trace_file_header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t pid;
+    uint32_t dropped;
+    uint64_t ts0, ns0; /* trace_now() and CLOCK_MONOTONIC at trace_start() */
+    uint64_t ts1, ns1; /* trace_now() and CLOCK_MONOTONIC at trace_stop() */
+};
+
+static const char *const trace_point_name[NUM_TRACE_POINTS] = {
+    "open",
+    "tcgetattr",
+    "get_tl_settings",
+    "get_speed_baud",
+};
+
+__thread struct trace_ring *trace_ring_self;
+
+static struct trace_ring *_Atomic trace_rings;
+static atomic_int trace_active;
+static atomic_int trace_flusher_running;
+static pthread_t trace_flusher;
+static FILE *trace_fp;
+static struct trace_file_header trace_header;
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+*@fn trace_ring_register
+*@brief Allocate the calling thread's ring and link it for the flusher
+*@return Returns the ring on success,
+*        Returns NULL if tracing is not started or on allocation failure
+*/
+struct trace_ring *trace_ring_register(void)
+{
+    struct trace_ring *r;
+
+    if (!atomic_load_explicit(&trace_active, memory_order_acquire))
+        return NULL;
+
+    r = calloc(1, sizeof(*r));
+    if (r == NULL)
+        return NULL;
+    r->tid = (uint32_t)syscall(SYS_gettid);
+
+    r->next = atomic_load_explicit(&trace_rings, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&trace_rings, &r->next, r, memory_order_release,
+                                                  memory_order_relaxed))
+        ;
+    trace_ring_self = r;
+    return r;
+}
+
+/**
+*@fn trace_drain
+*@brief Write all pending events of every ring to the raw trace file
+*@return Returns the number of events written
+*/
+static uint32_t trace_drain(void)
+{
+    struct trace_ring *r;
+    uint32_t head, tail, n, total = 0;
+    uint32_t first;
+
+    for (r = atomic_load_explicit(&trace_rings, memory_order_acquire); r != NULL; r = r->next)
+    {
+        tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        head = atomic_load_explicit(&r->head, memory_order_acquire);
+        n = head - tail;
+        if (n == 0)
+            continue;
+
+        /* Copy out in at most two chunks when the pending span wraps */
+        first = TRACE_RING_SIZE - (tail & (TRACE_RING_SIZE - 1));
+        if (first > n)
+            first = n;
+        fwrite(&r->events[tail & (TRACE_RING_SIZE - 1)], sizeof(struct trace_event), first, trace_fp);
+        fwrite(&r->events[0], sizeof(struct trace_event), n - first, trace_fp);
+
+        atomic_store_explicit(&r->tail, head, memory_order_release);
+        total += n;
+    }
+    return total;
+}
+
+static void *trace_flusher_main(void *arg)
+{
+    const struct timespec interval = {0, TRACE_FLUSH_INTERVAL_NS};
+
+    (void)arg;
+    while (atomic_load_explicit(&trace_flusher_running, memory_order_acquire))
+    {
+        if (trace_drain() == 0)
+            nanosleep(&interval, NULL);
+    }
+    trace_drain();
+    return NULL;
+}
+
+/**
+*@fn trace_start
+*@brief Start recording trace points into a raw binary trace file
+*@param raw_path path of the raw trace file to create
+*@return Returns '0' on success,
+*        Returns '1' on failure
+*/
+int trace_start(const char *raw_path)
+{
+    struct trace_ring *r;
+
+    if (atomic_load(&trace_active))
+        return EXIT_FAILURE;
+
+    trace_fp = fopen(raw_path, "wb");
+    if (trace_fp == NULL)
+        return EXIT_FAILURE;
+
+    /* Discard whatever was recorded while stopped */
+    for (r = atomic_load(&trace_rings); r != NULL; r = r->next)
+    {
+        atomic_store(&r->tail, atomic_load(&r->head));
+        atomic_store(&r->dropped, 0);
+    }
+
+    memset(&trace_header, 0, sizeof(trace_header));
+    memcpy(trace_header.magic, TRACE_MAGIC, sizeof(trace_header.magic));
+    trace_header.version = TRACE_VERSION;
+    trace_header.pid = (uint32_t)getpid();
+    trace_header.ts0 = trace_now();
+    trace_header.ns0 = monotonic_ns();
+    fwrite(&trace_header, sizeof(trace_header), 1, trace_fp);
+
+    atomic_store(&trace_flusher_running, 1);
+    if (pthread_create(&trace_flusher, NULL, trace_flusher_main, NULL))
+    {
+        fclose(trace_fp);
+        trace_fp = NULL;
+        return EXIT_FAILURE;
+    }
+    atomic_store(&trace_active, 1);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+*@fn trace_stop
+*@brief Stop recording, flush all rings and finalize the raw trace file
+*@return Returns '0' on success,
+*        Returns '1' on failure
+*/
+int trace_stop(void)
+{
+    struct trace_ring *r;
+    int ret;
+
+    if (!atomic_load(&trace_active))
+        return EXIT_FAILURE;
+    atomic_store(&trace_active, 0);
+
+    trace_header.ts1 = trace_now();
+    trace_header.ns1 = monotonic_ns();
+    atomic_store(&trace_flusher_running, 0);
+    pthread_join(trace_flusher, NULL);
+
+    for (r = atomic_load(&trace_rings); r != NULL; r = r->next)
+    {
+        trace_header.dropped += atomic_load(&r->dropped);
+    }
+
+    /* Rewrite the header now that the clock calibration end point is known */
+    ret = fseek(trace_fp, 0, SEEK_SET) || fwrite(&trace_header, sizeof(trace_header), 1, trace_fp) != 1;
+    ret |= fclose(trace_fp) != 0;
+    trace_fp = NULL;
+
+    return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+*@fn trace_export_chrome
+*@brief Convert a raw trace file to Chrome/Perfetto trace event JSON
+*@param raw_path raw trace file written between trace_start() and trace_stop()
+*@param json_path output JSON file
+*@return Returns '0' on success,
+*        Returns '1' on failure
+*/
+int trace_export_chrome(const char *raw_path, const char *json_path)
+{
+    struct trace_file_header hdr;
+    struct trace_event e;
+    FILE *in, *out;
+    double ns_per_tick = 1.0;
+    int first = 1;
+
+    in = fopen(raw_path, "rb");
+    if (in == NULL)
+        return EXIT_FAILURE;
+    if (fread(&hdr, sizeof(hdr), 1, in) != 1 || memcmp(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic)) ||
+        hdr.version != TRACE_VERSION)
+    {
+        fclose(in);
+        return EXIT_FAILURE;
+    }
+    out = fopen(json_path, "w");
+    if (out == NULL)
+    {
+        fclose(in);
+        return EXIT_FAILURE;
+    }
+
+    if (hdr.ts1 > hdr.ts0 && hdr.ns1 > hdr.ns0)
+    {
+        ns_per_tick = (double)(hdr.ns1 - hdr.ns0) / (double)(hdr.ts1 - hdr.ts0);
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":%u},\"traceEvents\":[", hdr.dropped);
+    while (fread(&e, sizeof(e), 1, in) == 1)
+    {
+        if (e.point >= NUM_TRACE_POINTS)
+            continue;
+        /* Chrome trace timestamps are microseconds */
+        fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%u,\"tid\":%u}", first ? "" : ",",
+                trace_point_name[e.point], e.phase, (double)(int64_t)(e.ts - hdr.ts0) * ns_per_tick / 1000.0,
+                hdr.pid, e.tid);
+        first = 0;
+    }
+    fprintf(out, "\n]}\n");
+
+    fclose(in);
+    return fclose(out) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif /* SERIAL_TRACE */
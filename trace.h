@@ -0,0 +1,106 @@
+#ifndef SERIAL_TRACE_H
+#define SERIAL_TRACE_H
+
+/* Trace points, keep in sync with trace_point_name[] in trace.c */
+enum
+{
+    TRACE_OPEN,
+    TRACE_TCGETATTR,
+    TRACE_GET_TL_SETTINGS,
+    TRACE_GET_SPEED_BAUD,
+    NUM_TRACE_POINTS
+};
+
+#ifdef SERIAL_TRACE
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/* Events per thread, must be a power of two */
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 4096
+#endif
+
+#define TRACE_PHASE_BEGIN 'B'
+#define TRACE_PHASE_END 'E'
+
+/* One fixed-size binary event, written as-is to the raw trace file */
+struct trace_event
+{
+    uint64_t ts;    /* TSC ticks or CLOCK_MONOTONIC ns, see trace_now() */
+    uint32_t tid;
+    uint16_t point;
+    uint16_t phase;
+};
+
+/* Single producer (owning thread) / single consumer (flusher) ring.
+ * Rings are never freed, a thread's ring outlives the thread.
+ */
+struct trace_ring
+{
+    _Atomic uint32_t head; /* Written by the owning thread only */
+    char pad[60];          /* Keep head and tail on separate cache lines */
+    _Atomic uint32_t tail; /* Written by the flusher only */
+    _Atomic uint32_t dropped;
+    uint32_t tid;
+    struct trace_ring *next;
+    struct trace_event events[TRACE_RING_SIZE];
+};
+
+extern __thread struct trace_ring *trace_ring_self;
+
+struct trace_ring *trace_ring_register(void);
+
+static inline uint64_t trace_now(void)
+{
+#if defined(SERIAL_TRACE_TSC) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline void trace_emit(unsigned point, unsigned phase)
+{
+    struct trace_ring *r = trace_ring_self;
+    struct trace_event *e;
+    uint32_t head;
+
+    if (r == NULL && (r = trace_ring_register()) == NULL)
+        return; /* tracing not started */
+
+    head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&r->tail, memory_order_acquire) >= TRACE_RING_SIZE)
+    {
+        /* Ring full, never block the traced thread */
+        atomic_store_explicit(&r->dropped, atomic_load_explicit(&r->dropped, memory_order_relaxed) + 1,
+                              memory_order_relaxed);
+        return;
+    }
+    e = &r->events[head & (TRACE_RING_SIZE - 1)];
+    e->ts = trace_now();
+    e->tid = r->tid;
+    e->point = point;
+    e->phase = phase;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+#define TRACE_BEGIN(p) trace_emit((p), TRACE_PHASE_BEGIN)
+#define TRACE_END(p) trace_emit((p), TRACE_PHASE_END)
+
+int trace_start(const char *raw_path);
+int trace_stop(void);
+int trace_export_chrome(const char *raw_path, const char *json_path);
+
+#else /* !SERIAL_TRACE */
+
+#define TRACE_BEGIN(p) ((void)0)
+#define TRACE_END(p) ((void)0)
+
+#endif /* SERIAL_TRACE */
+
+#endif /* SERIAL_TRACE_H */
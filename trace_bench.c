@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "trace.h"
+
+#ifndef SERIAL_TRACE
+#error "trace_bench must be built with -DSERIAL_TRACE"
+#endif
+
+#define BENCH_ROUNDS 2000
+#define BENCH_BURST (TRACE_RING_SIZE / 2) /* Events per round, never overflows the ring */
+
+static uint64_t bench_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Measures the cost of one TRACE_BEGIN/TRACE_END event while the flusher runs
+int main(int argc, char *argv[])
+{
+    const char *raw_path = argc > 1 ? argv[1] : "trace_bench.trace";
+    uint64_t start, total = 0;
+    int round, i;
+
+    if (trace_start(raw_path))
+    {
+        printf(" Error in starting trace to %s\n", raw_path);
+        return 1;
+    }
+    TRACE_BEGIN(TRACE_OPEN); /* Register this thread's ring outside the timed loop */
+    TRACE_END(TRACE_OPEN);
+
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        /* Let the flusher drain so no event is timed on the drop path */
+        while (atomic_load(&trace_ring_self->head) != atomic_load(&trace_ring_self->tail))
+            ;
+
+        start = bench_ns();
+        for (i = 0; i < BENCH_BURST; i += 2)
+        {
+            TRACE_BEGIN(TRACE_GET_TL_SETTINGS);
+            TRACE_END(TRACE_GET_TL_SETTINGS);
+        }
+        total += bench_ns() - start;
+    }
+
+    trace_stop();
+    printf(" %d events, %.1f ns/event, %u dropped\n", BENCH_ROUNDS * BENCH_BURST,
+           (double)total / ((double)BENCH_ROUNDS * BENCH_BURST), atomic_load(&trace_ring_self->dropped));
+
+    return 0;
+}